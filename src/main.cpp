@@ -14,16 +14,17 @@ namespace fs = std::filesystem;
 
 void help() {
     std::cout << "Usage:\n";
-    std::cout << "\tpacker [--log-level=<level>] pack <source_directory> <output_file>\n";
+    std::cout << "\tpacker [--log-level=<level>] pack <source_directory> <output_file> [<volume_file>...]\n";
     std::cout << "\tpacker [--log-level=<level>] unpack <input_file> <target_directory>\n";
     std::cout << "Options:\n";
-    std::cout << "\tpack\tPacks the source directory into the specified archive file\n";
-    std::cout << "\tunpack\tUnpacks the archive into the target directory\n";
+    std::cout << "\tpack\tPacks the source directory into the specified archive file. If volume files are given,\n";
+    std::cout << "\t\tcontents are written to them in parallel and the archive file only keeps the manifest\n";
+    std::cout << "\tunpack\tUnpacks the archive (or manifest of a multi-volume one) into the target directory\n";
     std::cout << "\t--log-level\tLogging level: error, warning, info, none (default: info)";
 }
 
 int handle_pack_cmd(const std::vector<std::string>& args) {
-    if (args.size() != 2) {
+    if (args.size() < 2) {
         std::cerr << "Error: invalid arguments for 'pack' command\n";
         help();
         return 1;
@@ -31,6 +32,7 @@ int handle_pack_cmd(const std::vector<std::string>& args) {
 
     fs::path src_dir = args[0];
     fs::path dst_file = args[1];
+    std::vector<fs::path> volume_files(args.begin() + 2, args.end());
 
     if (!fs::exists(src_dir) || !fs::is_directory(src_dir)) {
         std::cerr << "Error: source directory doesn't exist or is not a directory\n";
@@ -39,7 +41,11 @@ int handle_pack_cmd(const std::vector<std::string>& args) {
 
     try {
         Packer packer(std::make_unique<XxHashHasher>());
-        packer.pack(src_dir, dst_file);
+        if (volume_files.empty()) {
+            packer.pack(src_dir, dst_file);
+        } else {
+            packer.pack(src_dir, dst_file, volume_files);
+        }
     } catch (const std::exception& ex) {
         std::cerr << "Packing failed: " << ex.what() << "\n";
         std::cerr << "Feel really sorry for the time traveller :(\n";
@@ -1,12 +1,174 @@
 #include "packer.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <fstream>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <set>
+#include <thread>
 
 #include "utils/logger.hpp"
 
 namespace fs = std::filesystem;
 
+namespace {
+
+// Unique file scheduled for copying into a particular volume
+struct VolumeJob {
+    fs::path file_path;
+    uint64_t file_size;
+};
+
+// Feeds a single volume writer thread. Unbounded on purpose: jobs are tiny,
+// the actual data is read by the writer itself
+class VolumeJobQueue {
+public:
+    void push(VolumeJob job) {
+        {
+            std::lock_guard<std::mutex> lck(mutex_);
+            jobs_.push_back(std::move(job));
+        }
+        cv_.notify_one();
+    }
+
+    // No more jobs will come, the ones already queued are still handed out
+    void close() {
+        {
+            std::lock_guard<std::mutex> lck(mutex_);
+            closed_ = true;
+        }
+        cv_.notify_one();
+    }
+
+    // Pack has failed, queued jobs are dropped so the writer stops right away
+    void abort() {
+        {
+            std::lock_guard<std::mutex> lck(mutex_);
+            aborted_ = true;
+            jobs_.clear();
+        }
+        cv_.notify_one();
+    }
+
+    // Blocks until there is a job or the queue is closed and drained (or aborted)
+    std::optional<VolumeJob> pop() {
+        std::unique_lock<std::mutex> lck(mutex_);
+        cv_.wait(lck, [this] { return !jobs_.empty() || closed_ || aborted_; });
+        if (jobs_.empty() || aborted_) {
+            return std::nullopt;
+        }
+        VolumeJob job = std::move(jobs_.front());
+        jobs_.pop_front();
+        return job;
+    }
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<VolumeJob> jobs_;
+    bool closed_ = false;
+    bool aborted_ = false;
+};
+
+uint64_t generate_archive_id() {
+    std::random_device rd;
+    return (static_cast<uint64_t>(rd()) << 32) | rd();
+}
+
+// Volumes living under the manifest's directory are stored relative to it,
+// so such archive can be moved around as a whole
+std::string volume_path_for_manifest(const fs::path& volume_file, const fs::path& manifest_file) {
+    fs::path volume = fs::absolute(volume_file).lexically_normal();
+    fs::path base = fs::absolute(manifest_file).lexically_normal().parent_path();
+    fs::path rel = volume.lexically_relative(base);
+    if (!rel.empty() && *rel.begin() != "..") {
+        return rel.string();
+    }
+    return volume.string();
+}
+
+fs::path resolve_volume_path(const std::string& stored_path, const fs::path& manifest_file) {
+    fs::path volume(stored_path);
+    if (volume.is_relative()) {
+        return manifest_file.parent_path() / volume;
+    }
+    return volume;
+}
+
+// Owns worker threads and joins them when going out of scope, so that no
+// exception (including failing to start a thread) leaves joinable threads behind
+class WorkerGroup {
+public:
+    // on_cancel must make workers give up on the rest of their work, it's
+    // called by cancel() and when the group goes out of scope
+    WorkerGroup(std::size_t max_workers, std::function<void()> on_cancel = {})
+        : errors_(max_workers), on_cancel_(std::move(on_cancel)) {
+        threads_.reserve(max_workers);
+    }
+
+    ~WorkerGroup() {
+        cancel();
+        join_threads();
+    }
+
+    // Runs fn in a new thread, exception escaping fn is rethrown by join()
+    template<typename Fn>
+    void spawn(Fn fn) {
+        std::size_t slot = threads_.size();
+        if (slot >= errors_.size()) {
+            throw std::logic_error("Too many workers spawned");
+        }
+        threads_.emplace_back([this, slot, fn = std::move(fn)] {
+            try {
+                fn();
+            } catch (...) {
+                errors_[slot] = std::current_exception();
+                failed_ = true;
+            }
+        });
+    }
+
+    bool failed() const {
+        return failed_;
+    }
+
+    void cancel() {
+        if (on_cancel_) {
+            on_cancel_();
+        }
+    }
+
+    // Waits for all workers, then rethrows the first error reported by any of them
+    void join() {
+        join_threads();
+        for (const auto& error : errors_) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+private:
+    void join_threads() {
+        for (auto& thread : threads_) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+    }
+
+    std::vector<std::thread> threads_;
+    std::vector<std::exception_ptr> errors_;
+    std::atomic<bool> failed_{false};
+    std::function<void()> on_cancel_;
+};
+
+} // namespace
+
 Packer::Packer() : buffer_(BufferSize) {}
 
 Packer::Packer(std::unique_ptr<Hasher> hasher) : hasher_(std::move(hasher)),
@@ -31,7 +193,14 @@ void Packer::pack(const fs::path& src_dir, const fs::path& pack_file) {
     write_header(out, header);
 
     // Pack files from src_dir into the pack file
-    auto [file_table, num_of_files] = pack_files(out, src_dir);
+    uint64_t curr_offset = out.tellp();
+    auto [file_table, num_of_files] = pack_files(src_dir, [&](const fs::path& file_path, FileTableEntry& entry) {
+        Logger(LogLevel::INFO) << "\tCopying to pack file...";
+        entry.data_offset = curr_offset;
+        copy_file_content(out, file_path, entry.file_size, buffer_);
+        curr_offset += entry.file_size;
+        Logger(LogLevel::INFO) << "\tCopying complete!";
+    });
 
     Logger(LogLevel::INFO) << "==== SUMMARY ====";
     Logger(LogLevel::INFO) << "Number of files processed: " << num_of_files;
@@ -41,7 +210,7 @@ void Packer::pack(const fs::path& src_dir, const fs::path& pack_file) {
 
     // Write FileTable
     uint64_t file_table_offset = out.tellp();
-    write_file_table(out, file_table);
+    write_file_table(out, file_table, false);
 
     // Update FileTable offset information
     header.file_table_offset = file_table_offset;
@@ -49,6 +218,164 @@ void Packer::pack(const fs::path& src_dir, const fs::path& pack_file) {
     write_header(out, header);
 }
 
+void Packer::pack(const fs::path& src_dir,
+                  const fs::path& manifest_file,
+                  const std::vector<fs::path>& volume_files) {
+    if (!hasher_) {
+        throw std::runtime_error("Cannot pack files without hasher provided\n");
+    }
+    if (volume_files.empty()) {
+        throw std::runtime_error("Cannot pack into volumes without any volume file provided");
+    }
+    if (volume_files.size() > MaxVolumes) {
+        throw std::runtime_error("Too many volume files provided, max is " + std::to_string(MaxVolumes));
+    }
+
+    // Manifest and volumes are written to temporary files and renamed only when
+    // all of them are complete, so failed pack never clobbers previous archive
+    auto tmp_path = [](const fs::path& path) {
+        fs::path tmp = path;
+        tmp += ".tmp";
+        return tmp;
+    };
+    fs::path tmp_manifest_file = tmp_path(manifest_file);
+    std::vector<fs::path> tmp_volume_files;
+    for (const auto& volume_file : volume_files) {
+        tmp_volume_files.push_back(tmp_path(volume_file));
+    }
+
+    // Two writers sharing the same file (final or temporary one) would
+    // silently corrupt each other
+    std::set<fs::path> unique_files{fs::weakly_canonical(manifest_file), fs::weakly_canonical(tmp_manifest_file)};
+    for (uint64_t i = 0; i < volume_files.size(); i++) {
+        if (!unique_files.insert(fs::weakly_canonical(volume_files[i])).second ||
+            !unique_files.insert(fs::weakly_canonical(tmp_volume_files[i])).second) {
+            throw std::runtime_error("Volume file is used more than once: " + volume_files[i].string());
+        }
+    }
+
+    // Opening manifest upfront saves packing anything if it's not writable
+    std::ofstream manifest(tmp_manifest_file, std::ios::binary);
+    if (!manifest) {
+        throw std::runtime_error("Cannot open manifest file for write: " + tmp_manifest_file.string());
+    }
+
+    Logger(LogLevel::INFO) << "Packing log files from " << src_dir.string()
+                           << " into: " << manifest_file.string()
+                           << " (" << volume_files.size() << " volumes)";
+
+    ManifestHeader header;
+    header.archive_id = generate_archive_id();
+    header.volume_count = volume_files.size();
+
+    try {
+        std::vector<uint64_t> volume_sizes;
+        auto [file_table, num_of_files] = pack_volumes(src_dir, tmp_volume_files, header.archive_id, volume_sizes);
+
+        Logger(LogLevel::INFO) << "==== SUMMARY ====";
+        Logger(LogLevel::INFO) << "Number of files processed: " << num_of_files;
+        Logger(LogLevel::INFO) << "Number of unique files packed: " << file_table.size();
+        Logger(LogLevel::INFO) << "Number of identical files: " << num_of_files - file_table.size();
+        for (uint64_t i = 0; i < volume_files.size(); i++) {
+            Logger(LogLevel::INFO) << "Volume " << i << ": " << volume_files[i].string()
+                                   << " (" << volume_sizes[i] << " bytes)";
+        }
+        Logger(LogLevel::INFO) << "=================";
+
+        std::vector<VolumeTableEntry> volume_table;
+        for (uint64_t i = 0; i < volume_files.size(); i++) {
+            volume_table.push_back(VolumeTableEntry{volume_path_for_manifest(volume_files[i], manifest_file),
+                                                    volume_sizes[i]});
+        }
+        manifest.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        write_volume_table(manifest, volume_table);
+        write_file_table(manifest, file_table, true);
+        manifest.close();
+        if (!manifest) {
+            throw std::runtime_error("Failed to write manifest file: " + tmp_manifest_file.string());
+        }
+        for (uint64_t i = 0; i < volume_files.size(); i++) {
+            fs::rename(tmp_volume_files[i], volume_files[i]);
+        }
+        fs::rename(tmp_manifest_file, manifest_file);
+    } catch (...) {
+        manifest.close();
+        std::error_code ec;
+        fs::remove(tmp_manifest_file, ec);
+        for (const auto& tmp_volume_file : tmp_volume_files) {
+            fs::remove(tmp_volume_file, ec);
+        }
+        throw;
+    }
+}
+
+std::pair<Packer::FileTable, uint64_t> Packer::pack_volumes(const fs::path& src_dir,
+                                                            const std::vector<fs::path>& volume_files,
+                                                            uint64_t archive_id,
+                                                            std::vector<uint64_t>& volume_sizes) {
+    // Every volume gets its own writer thread fed through its own queue, so
+    // hashing (below, in this thread) overlaps with copying into all volumes.
+    // On failure writers are cancelled by aborting their queues
+    std::vector<VolumeJobQueue> queues(volume_files.size());
+    WorkerGroup writers(volume_files.size(), [&queues] {
+        for (auto& queue : queues) {
+            queue.abort();
+        }
+    });
+    for (uint64_t i = 0; i < volume_files.size(); i++) {
+        writers.spawn([&, i] {
+            std::ofstream out(volume_files[i], std::ios::binary);
+            if (!out) {
+                throw std::runtime_error("Cannot open volume file for write: " + volume_files[i].string());
+            }
+            VolumeHeader volume_header;
+            volume_header.archive_id = archive_id;
+            volume_header.volume_index = i;
+            out.write(reinterpret_cast<const char*>(&volume_header), sizeof(volume_header));
+
+            std::vector<char> buffer(BufferSize);
+            while (auto job = queues[i].pop()) {
+                copy_file_content(out, job->file_path, job->file_size, buffer);
+            }
+            out.flush();
+            if (!out) {
+                throw std::runtime_error("Failed to write volume file: " + volume_files[i].string());
+            }
+        });
+    }
+
+    // Offsets are planned here, writers just append blobs in the same order.
+    // Each unique file goes to the least loaded volume to keep them balanced
+    volume_sizes.assign(volume_files.size(), sizeof(VolumeHeader));
+    std::pair<FileTable, uint64_t> pack_result;
+    try {
+        pack_result = pack_files(src_dir, [&](const fs::path& file_path, FileTableEntry& entry) {
+            if (writers.failed()) {
+                throw std::runtime_error("Volume writer failed");
+            }
+            auto volume = std::min_element(volume_sizes.begin(), volume_sizes.end());
+            entry.volume_index = volume - volume_sizes.begin();
+            entry.data_offset = *volume;
+            *volume += entry.file_size;
+            queues[entry.volume_index].push(VolumeJob{file_path, entry.file_size});
+            Logger(LogLevel::INFO) << "\tQueued for volume " << entry.volume_index;
+        });
+    } catch (...) {
+        // Prefer reporting the writer's error, it's the root cause if any
+        writers.cancel();
+        writers.join();
+        throw;
+    }
+
+    // Let writers drain what's already queued
+    for (auto& queue : queues) {
+        queue.close();
+    }
+    Logger(LogLevel::INFO) << "Waiting for volume writers to finish...";
+    writers.join();
+    return pack_result;
+}
+
 void Packer::unpack(const fs::path& pack_file, const std::filesystem::path& dst_dir) {
     std::ifstream in(pack_file, std::ios::binary);
     if (!in) {
@@ -58,28 +385,107 @@ void Packer::unpack(const fs::path& pack_file, const std::filesystem::path& dst_
     Logger(LogLevel::INFO) << "Unpacking files from " << pack_file.string()
                            << " into " << dst_dir.string();
 
+    if (read_magic(in) == "TMLM") {
+        unpack_volumes(in, pack_file, dst_dir);
+        return;
+    }
+
     PackHeader header = read_header(in);
-    auto [file_table, num_of_files]  = read_file_table(in, header.file_table_offset);
+    in.seekg(header.file_table_offset);
+    auto [file_table, num_of_files]  = read_file_table(in, false);
+
+    for (const auto& entry : file_table) {
+        for (const auto& relative_path : entry.file_paths) {
+            fs::create_directories((dst_dir / relative_path).parent_path());
+        }
+        unpack_file_content(in, entry, dst_dir, buffer_);
+    }
+
+    Logger(LogLevel::INFO) << "==== SUMMARY ====";
+    Logger(LogLevel::INFO) << "Number of files processed: " << num_of_files;
+    Logger(LogLevel::INFO) << "Number of unique files unpacked: " << file_table.size();
+    Logger(LogLevel::INFO) << "Number of identical files: " << num_of_files - file_table.size();
+    Logger(LogLevel::INFO) << "=================";
+}
+
+void Packer::unpack_volumes(std::ifstream& in, const fs::path& manifest_file, const fs::path& dst_dir) {
+    ManifestHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in) {
+        throw std::runtime_error("Invalid manifest format: truncated header");
+    }
+    if (header.volume_count > MaxVolumes) {
+        throw std::runtime_error("Invalid manifest format: too many volumes");
+    }
+    auto volume_table = read_volume_table(in, header.volume_count);
+    auto [file_table, num_of_files] = read_file_table(in, true);
 
+    // Split the work by volumes, each one is read by its own thread
+    std::vector<std::vector<const FileTableEntry*>> volume_entries(volume_table.size());
     for (const auto& entry : file_table) {
-        unpack_file_content(in, entry, dst_dir);
+        if (entry.volume_index >= volume_table.size()) {
+            throw std::runtime_error("Invalid manifest format: file refers to unknown volume");
+        }
+        uint64_t volume_size = volume_table[entry.volume_index].size;
+        if (entry.data_offset < sizeof(VolumeHeader) || entry.data_offset > volume_size ||
+            entry.file_size > volume_size - entry.data_offset) {
+            throw std::runtime_error("Invalid manifest format: file data is out of volume bounds");
+        }
+        volume_entries[entry.volume_index].push_back(&entry);
+        // Create directories upfront, so that readers don't race for them
+        // (unpack_file_content expects them to exist)
+        for (const auto& relative_path : entry.file_paths) {
+            fs::create_directories((dst_dir / relative_path).parent_path());
+        }
     }
 
+    WorkerGroup readers(volume_table.size());
+    for (uint64_t i = 0; i < volume_table.size(); i++) {
+        if (volume_entries[i].empty()) {
+            continue;
+        }
+        readers.spawn([&, i] {
+            fs::path volume_file = resolve_volume_path(volume_table[i].path, manifest_file);
+            std::ifstream volume(volume_file, std::ios::binary);
+            if (!volume) {
+                throw std::runtime_error("Failed to open volume file for read: " + volume_file.string());
+            }
+
+            VolumeHeader volume_header;
+            volume.read(reinterpret_cast<char*>(&volume_header), sizeof(volume_header));
+            if (!volume || std::string(volume_header.magic, sizeof(volume_header.magic)) != "TMLV" ||
+                volume_header.archive_id != header.archive_id ||
+                volume_header.volume_index != i) {
+                throw std::runtime_error("Volume doesn't belong to this archive: " + volume_file.string());
+            }
+            if (fs::file_size(volume_file) != volume_table[i].size) {
+                throw std::runtime_error("Volume size mismatch (truncated?): " + volume_file.string());
+            }
+
+            std::vector<char> buffer(BufferSize);
+            for (const auto* entry : volume_entries[i]) {
+                unpack_file_content(volume, *entry, dst_dir, buffer);
+            }
+        });
+    }
+    readers.join();
+
     Logger(LogLevel::INFO) << "==== SUMMARY ====";
+    Logger(LogLevel::INFO) << "Number of volumes: " << volume_table.size();
     Logger(LogLevel::INFO) << "Number of files processed: " << num_of_files;
     Logger(LogLevel::INFO) << "Number of unique files unpacked: " << file_table.size();
     Logger(LogLevel::INFO) << "Number of identical files: " << num_of_files - file_table.size();
     Logger(LogLevel::INFO) << "=================";
 }
 
-std::pair<Packer::FileTable, uint64_t> Packer::pack_files(std::ofstream& out, const std::filesystem::path& src_dir) {
+std::pair<Packer::FileTable, uint64_t> Packer::pack_files(const std::filesystem::path& src_dir,
+                                                          const BlobStore& store_blob) {
     FileTable file_table;
     uint64_t files_num = 0;
-    uint64_t curr_offset = out.tellp();
 
     // Iterate over files in src_dir and:
     //    * collect info about it into the file table;
-    //    * write contents into the final pack file (if needed)
+    //    * store contents into the pack (if needed)
     for (const auto& entry : fs::recursive_directory_iterator(src_dir)) {
         if (!entry.is_regular_file())
         {
@@ -106,10 +512,8 @@ std::pair<Packer::FileTable, uint64_t> Packer::pack_files(std::ofstream& out, co
             it->second.file_paths.push_back(rel_path);
             Logger(LogLevel::INFO) << "\tFile with similar content discovered. No need to pack";
         } else {
-            Logger(LogLevel::INFO) << "\tCopying to pack file...";
-            file_table[file_hash] = FileTableEntry{{rel_path}, file_size, curr_offset};
-            curr_offset = write_file_content(out, entry.path(), curr_offset);
-            Logger(LogLevel::INFO) << "\tCopying complete!";
+            auto& new_entry = file_table[file_hash] = FileTableEntry{{rel_path}, file_size};
+            store_blob(entry.path(), new_entry);
         }
 
         Logger(LogLevel::INFO) << "Packing complete!";
@@ -122,7 +526,16 @@ void Packer::write_header(std::ofstream& out, const PackHeader& header) {
     out.write(reinterpret_cast<const char*>(&header), sizeof(header));
 }
 
-void Packer::write_file_table(std::ofstream& out, const FileTable& file_table) {
+void Packer::write_volume_table(std::ofstream& out, const std::vector<VolumeTableEntry>& volumes) {
+    for (const auto& volume : volumes) {
+        uint64_t path_len = volume.path.size();
+        out.write(reinterpret_cast<const char*>(&path_len), sizeof(path_len));
+        out.write(volume.path.data(), path_len);
+        out.write(reinterpret_cast<const char*>(&volume.size), sizeof(volume.size));
+    }
+}
+
+void Packer::write_file_table(std::ofstream& out, const FileTable& file_table, bool with_volumes) {
     const char marker[9] = {'F', 'I', 'L', 'E', 'T', 'A', 'B', 'L', 'E'};
     out.write(marker, sizeof(marker));
 
@@ -139,25 +552,41 @@ void Packer::write_file_table(std::ofstream& out, const FileTable& file_table) {
         }
         out.write(reinterpret_cast<const char*>(&entry.file_size), sizeof(entry.file_size));
         out.write(reinterpret_cast<const char*>(&entry.data_offset), sizeof(entry.data_offset));
+        // Single pack files predate volumes, so the index is only stored in manifests
+        if (with_volumes) {
+            out.write(reinterpret_cast<const char*>(&entry.volume_index), sizeof(entry.volume_index));
+        }
     }
 }
 
-uint64_t Packer::write_file_content(std::ofstream& out,
-                                    const std::filesystem::path& file_path,
-                                    uint64_t offset_in_pack) {
+void Packer::copy_file_content(std::ofstream& out,
+                               const std::filesystem::path& file_path,
+                               uint64_t file_size,
+                               std::vector<char>& buffer) {
     std::ifstream in(file_path, std::ios::binary);
     if (!in) {
-        // What shall we do about it? Should it be recoverable?
         throw std::runtime_error("Failed to open log file for read: " + file_path.string());
     }
 
-    out.seekp(offset_in_pack);
-    uint64_t next_offset = offset_in_pack;
-    while (in.read(buffer_.data(), buffer_.size()) || in.gcount()) {
-        out.write(buffer_.data(), in.gcount());
-        next_offset += in.gcount();
+    // Offsets are planned from the size known at hashing time, so exactly
+    // file_size bytes must be copied even if the file has been changed since
+    uint64_t remaining = file_size;
+    while (remaining > 0) {
+        uint64_t to_read = std::min<uint64_t>(buffer.size(), remaining);
+        if (!in.read(buffer.data(), to_read)) {
+            throw std::runtime_error("Log file shrank while packing: " + file_path.string());
+        }
+        out.write(buffer.data(), to_read);
+        remaining -= to_read;
     }
-    return next_offset;
+}
+
+std::string Packer::read_magic(std::ifstream& in) {
+    char magic[4] = {};
+    in.read(magic, sizeof(magic));
+    in.clear();
+    in.seekg(0);
+    return std::string(magic, sizeof(magic));
 }
 
 Packer::PackHeader Packer::read_header(std::ifstream& in) {
@@ -170,9 +599,7 @@ Packer::PackHeader Packer::read_header(std::ifstream& in) {
 }
 
 std::pair<std::vector<Packer::FileTableEntry>, uint64_t> Packer::read_file_table(
-    std::ifstream& in, uint64_t file_table_offset) {
-    in.seekg(file_table_offset);
-
+    std::ifstream& in, bool with_volumes) {
     char marker[9];
     in.read(marker, sizeof(marker));
     if (std::string(marker, sizeof(marker)) != "FILETABLE") {
@@ -182,16 +609,25 @@ std::pair<std::vector<Packer::FileTableEntry>, uint64_t> Packer::read_file_table
     uint64_t num_of_files = 0;
     uint64_t entry_count;
     in.read(reinterpret_cast<char*>(&entry_count), sizeof(entry_count));
+    if (!in) {
+        throw std::runtime_error("Invalid pack format: truncated file table");
+    }
 
     std::vector<FileTableEntry> file_entries;
     for (uint64_t i = 0; i < entry_count; i++) {
         uint64_t path_count;
         in.read(reinterpret_cast<char*>(&path_count), sizeof(path_count));
+        if (!in) {
+            throw std::runtime_error("Invalid pack format: truncated file table");
+        }
 
         std::vector<std::string> paths;
         for (uint64_t j = 0; j < path_count; j++) {
             uint64_t path_len;
             in.read(reinterpret_cast<char*>(&path_len), sizeof(path_len));
+            if (!in) {
+                throw std::runtime_error("Invalid pack format: truncated file table");
+            }
             std::string path(path_len, '\0');
             in.read(&path[0], path_len);
             paths.push_back(path);
@@ -203,18 +639,42 @@ std::pair<std::vector<Packer::FileTableEntry>, uint64_t> Packer::read_file_table
         in.read(reinterpret_cast<char*>(&size), sizeof(size));
         uint64_t offset;
         in.read(reinterpret_cast<char*>(&offset), sizeof(offset));
+        uint64_t volume_index = 0;
+        if (with_volumes) {
+            in.read(reinterpret_cast<char*>(&volume_index), sizeof(volume_index));
+        }
+        if (!in) {
+            throw std::runtime_error("Invalid pack format: truncated file table");
+        }
 
-        file_entries.emplace_back(FileTableEntry{paths, size, offset});
+        file_entries.emplace_back(FileTableEntry{paths, size, offset, volume_index});
     }
     return {file_entries, num_of_files};
 }
 
+std::vector<Packer::VolumeTableEntry> Packer::read_volume_table(std::ifstream& in, uint64_t volume_count) {
+    std::vector<VolumeTableEntry> volumes;
+    for (uint64_t i = 0; i < volume_count; i++) {
+        uint64_t path_len;
+        in.read(reinterpret_cast<char*>(&path_len), sizeof(path_len));
+        std::string path(path_len, '\0');
+        in.read(&path[0], path_len);
+        uint64_t size;
+        in.read(reinterpret_cast<char*>(&size), sizeof(size));
+        if (!in) {
+            throw std::runtime_error("Invalid manifest format: truncated volume table");
+        }
+        volumes.push_back(VolumeTableEntry{path, size});
+    }
+    return volumes;
+}
+
 void Packer::unpack_file_content(std::ifstream& in,
                                  const FileTableEntry& entry,
-                                 const fs::path& dst_dir) {
+                                 const fs::path& dst_dir,
+                                 std::vector<char>& buffer) {
     for (const auto& relative_path : entry.file_paths) {
         fs::path full_path = dst_dir / relative_path;
-        fs::create_directories(full_path.parent_path());
         std::ofstream out(full_path, std::ios::binary);
         if (!out) {
             // What shall we do about it? Should it be recoverable?
@@ -227,9 +687,11 @@ void Packer::unpack_file_content(std::ifstream& in,
 
         uint64_t remaining = entry.file_size;
         while (remaining > 0) {
-            uint64_t to_read = std::min<uint64_t>(buffer_.size(), remaining);
-            in.read(buffer_.data(), to_read);
-            out.write(buffer_.data(), to_read);
+            uint64_t to_read = std::min<uint64_t>(buffer.size(), remaining);
+            if (!in.read(buffer.data(), to_read)) {
+                throw std::runtime_error("Invalid pack format: truncated contents of " + relative_path);
+            }
+            out.write(buffer.data(), to_read);
             remaining -= to_read;
         }
 
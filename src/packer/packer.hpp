@@ -2,6 +2,7 @@
 
 #include "hasher/hasher.hpp"
 #include <filesystem>
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -12,6 +13,12 @@ public:
     Packer();
     Packer(std::unique_ptr<Hasher> hasher);
     void pack(const std::filesystem::path& src_dir, const std::filesystem::path& pack_file);
+    // Multi-volume flavour: file contents are sharded across volume_files (each one
+    // written by its own thread) and manifest_file keeps only the file table
+    void pack(const std::filesystem::path& src_dir,
+              const std::filesystem::path& manifest_file,
+              const std::vector<std::filesystem::path>& volume_files);
+    // Accepts both single pack files and multi-volume manifests
     void unpack(const std::filesystem::path& pack_file, const std::filesystem::path& dst_dir);
 private:
 
@@ -20,7 +27,9 @@ private:
         // Array of relative paths sharing the same content
         std::vector<std::string> file_paths;
         uint64_t file_size;
-        uint64_t data_offset;
+        uint64_t data_offset = 0;
+        // Index of the volume holding the data (always 0 for single pack files)
+        uint64_t volume_index = 0;
     };
 
     struct PackHeader {
@@ -31,23 +40,63 @@ private:
         // to file table will be stored
         uint64_t file_table_offset = 0;
     };
+
+    struct ManifestHeader {
+        // TMLM = Time Machine Logs Manifest
+        const char magic[4] = {'T', 'M', 'L', 'M'};
+        // Random id shared by the manifest and all of its volumes, so that
+        // volumes of different archives can't be mixed up silently
+        uint64_t archive_id = 0;
+        uint64_t volume_count = 0;
+    };
+
+    struct VolumeHeader {
+        // TMLV = Time Machine Logs Volume
+        const char magic[4] = {'T', 'M', 'L', 'V'};
+        uint64_t archive_id = 0;
+        uint64_t volume_index = 0;
+    };
 #pragma pack(pop)
 
+    struct VolumeTableEntry {
+        // Relative to the manifest's directory when the volume lives under it,
+        // absolute otherwise (e.g. volume placed on another mount point)
+        std::string path;
+        uint64_t size;
+    };
+
     using FileTable = std::unordered_map<std::string, FileTableEntry>;
-    
+    // Stores content of a unique file somewhere in the pack and fills
+    // data_offset/volume_index of its entry accordingly
+    using BlobStore = std::function<void(const std::filesystem::path& file_path, FileTableEntry& entry)>;
+
     // Pack helpers
     void write_header(std::ofstream& out, const PackHeader& header);
-    uint64_t write_file_content(std::ofstream& out, const std::filesystem::path& file_path, uint64_t offset_in_pack);
-    void write_file_table(std::ofstream& out, const FileTable& table);
-    std::pair<FileTable, uint64_t> pack_files(std::ofstream& out, const std::filesystem::path& src_dir);
+    void copy_file_content(std::ofstream& out, const std::filesystem::path& file_path,
+                           uint64_t file_size, std::vector<char>& buffer);
+    void write_file_table(std::ofstream& out, const FileTable& table, bool with_volumes);
+    void write_volume_table(std::ofstream& out, const std::vector<VolumeTableEntry>& volumes);
+    std::pair<FileTable, uint64_t> pack_files(const std::filesystem::path& src_dir, const BlobStore& store_blob);
+    // Fills volume files in parallel, reports resulting size of each one via volume_sizes
+    std::pair<FileTable, uint64_t> pack_volumes(const std::filesystem::path& src_dir,
+                                                const std::vector<std::filesystem::path>& volume_files,
+                                                uint64_t archive_id,
+                                                std::vector<uint64_t>& volume_sizes);
 
     // Unpack helpers
+    std::string read_magic(std::ifstream& in);
     PackHeader read_header(std::ifstream& in);
-    std::pair<std::vector<FileTableEntry>, uint64_t> read_file_table(std::ifstream& in, uint64_t table_offset);
-    void unpack_file_content(std::ifstream& in, const FileTableEntry& entry, const std::filesystem::path& dst_dir);
+    std::pair<std::vector<FileTableEntry>, uint64_t> read_file_table(std::ifstream& in, bool with_volumes);
+    std::vector<VolumeTableEntry> read_volume_table(std::ifstream& in, uint64_t volume_count);
+    void unpack_volumes(std::ifstream& in, const std::filesystem::path& manifest_file,
+                        const std::filesystem::path& dst_dir);
+    void unpack_file_content(std::ifstream& in, const FileTableEntry& entry,
+                             const std::filesystem::path& dst_dir, std::vector<char>& buffer);
 
     std::unique_ptr<Hasher> hasher_;
     std::vector<char> buffer_;
 
     static constexpr std::size_t BufferSize = 4096 * 1024; 
+    // Each volume costs a thread and a buffer of BufferSize while (un)packing
+    static constexpr std::size_t MaxVolumes = 64;
 };
@@ -1,5 +1,6 @@
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <vector>
 
@@ -36,11 +37,37 @@ bool compare_dirs(const fs::path& dir1, const fs::path& dir2) {
     return true;
 }
 
+bool throws(const std::function<void()>& fn) {
+    try {
+        fn();
+    } catch (const std::exception& e) {
+        std::cout << "Expected failure: " << e.what() << std::endl;
+        return true;
+    }
+    return false;
+}
+
 int main() {
     fs::path temp_dir = fs::temp_directory_path() / "packer_test";
     fs::path original_dir = temp_dir / "original";
     fs::path packed_file = temp_dir / "archive.pak";
     fs::path unpacked_dir = temp_dir / "unpacked";
+    // One of the volumes lives outside of the manifest's directory,
+    // so it's referenced by absolute path (like on another mount point)
+    fs::path manifest_dir = temp_dir / "manifest";
+    fs::path manifest_file = manifest_dir / "archive.tmlm";
+    std::vector<fs::path> volume_files = {
+        manifest_dir / "archive.vol0",
+        manifest_dir / "volumes" / "archive.vol1",
+        temp_dir / "external" / "archive.vol2"
+    };
+    fs::path unpacked_volumes_dir = temp_dir / "unpacked_volumes";
+    // Small archives to check that broken volumes are rejected
+    fs::path small_dir = temp_dir / "small";
+    fs::path small_manifest = temp_dir / "small.tmlm";
+    std::vector<fs::path> small_volumes = {temp_dir / "small.vol0", temp_dir / "small.vol1"};
+    fs::path other_manifest = temp_dir / "other.tmlm";
+    std::vector<fs::path> other_volumes = {temp_dir / "other.vol0", temp_dir / "other.vol1"};
 
     try {
         fs::remove_all(temp_dir);
@@ -65,12 +92,83 @@ int main() {
         packer.unpack(packed_file, unpacked_dir);
         std::cout << "Unpaciking complete\n";
 
-        if (compare_dirs(original_dir, unpacked_dir)) {
-            std::cout << "Test PASSED!\n";
-        } else {
+        if (!compare_dirs(original_dir, unpacked_dir)) {
+            std::cout << "Test FAILED!\n";
+            return 1;
+        }
+
+        fs::create_directories(manifest_dir / "volumes");
+        fs::create_directories(temp_dir / "external");
+        packer.pack(original_dir, manifest_file, volume_files);
+        std::cout << "Multi-volume packing complete\n";
+
+        fs::create_directories(unpacked_volumes_dir);
+        packer.unpack(manifest_file, unpacked_volumes_dir);
+        std::cout << "Multi-volume unpacking complete\n";
+
+        if (!compare_dirs(original_dir, unpacked_volumes_dir)) {
             std::cout << "Test FAILED!\n";
             return 1;
         }
+
+        fs::create_directories(small_dir);
+        write_file(small_dir / "first.log", std::string(1024, 'D'));
+        write_file(small_dir / "second.log", std::string(2048, 'E'));
+
+        if (!throws([&] { packer.pack(small_dir, small_manifest, {small_volumes[0], small_volumes[0]}); })) {
+            std::cout << "Test FAILED: duplicate volume path accepted\n";
+            return 1;
+        }
+
+        fs::path tmp_manifest = small_manifest;
+        tmp_manifest += ".tmp";
+        if (!throws([&] { packer.pack(small_dir, small_manifest, {tmp_manifest}); })) {
+            std::cout << "Test FAILED: volume colliding with temporary manifest accepted\n";
+            return 1;
+        }
+
+        packer.pack(small_dir, small_manifest, small_volumes);
+        packer.pack(small_dir, other_manifest, other_volumes);
+
+        // Writer fails to open its volume: nothing is left behind and
+        // previously packed archive stays intact
+        fs::path broken_manifest = temp_dir / "broken.tmlm";
+        fs::path broken_tmp_manifest = broken_manifest;
+        broken_tmp_manifest += ".tmp";
+        if (!throws([&] { packer.pack(small_dir, broken_manifest, {temp_dir / "broken.vol0",
+                                                                   temp_dir / "nodir" / "broken.vol1"}); })) {
+            std::cout << "Test FAILED: unwritable volume accepted\n";
+            return 1;
+        }
+        if (fs::exists(broken_manifest) || fs::exists(broken_tmp_manifest) ||
+            fs::exists(temp_dir / "broken.vol0") || fs::exists(temp_dir / "broken.vol0.tmp")) {
+            std::cout << "Test FAILED: failed pack left files behind\n";
+            return 1;
+        }
+        if (!throws([&] { packer.pack(small_dir, small_manifest, {small_volumes[0],
+                                                                  temp_dir / "nodir" / "small.vol1"}); })) {
+            std::cout << "Test FAILED: unwritable volume accepted\n";
+            return 1;
+        }
+        packer.unpack(small_manifest, temp_dir / "unpacked_small");
+        if (!compare_dirs(small_dir, temp_dir / "unpacked_small")) {
+            std::cout << "Test FAILED: failed pack damaged previous archive\n";
+            return 1;
+        }
+
+        fs::copy_file(other_volumes[0], small_volumes[0], fs::copy_options::overwrite_existing);
+        if (!throws([&] { packer.unpack(small_manifest, temp_dir / "unpacked_swapped"); })) {
+            std::cout << "Test FAILED: volume of another archive accepted\n";
+            return 1;
+        }
+
+        fs::resize_file(other_volumes[1], fs::file_size(other_volumes[1]) - 1);
+        if (!throws([&] { packer.unpack(other_manifest, temp_dir / "unpacked_truncated"); })) {
+            std::cout << "Test FAILED: truncated volume accepted\n";
+            return 1;
+        }
+
+        std::cout << "Test PASSED!\n";
     } catch (const std::exception& e) {
         std::cout << "Test FAILED with exception: " << e.what() << "\n";
         return 1;